@@ -26,6 +26,27 @@ PLEASE FILL OUT THIS SECTION PRIOR TO SUBMISSION
 #include <vector>
 #include <fstream>
 #include <cmath>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 //***************************************************************************************************//
@@ -238,22 +259,78 @@ bool write_image(string filename, const vector<vector<Pixel>>& image)
 //                                DO NOT MODIFY THE SECTION ABOVE                                    //
 //***************************************************************************************************//
 
+//fixed-point scaling factors are stored as integers with FIXED_POINT_SHIFT fractional bits
+const int FIXED_POINT_SHIFT = 16;
+
+//0.3 and 0.8 rounded up to 16 fractional bits: matches int(color * factor) for every color in 0..255
+const int CLARENDON_DARKEN_FACTOR = 19661;
+const int DARKEN_FACTOR = 52429;
+
+//0.3 and 0.8 rounded down to 16 fractional bits: matches int(255 - (255 - color) * factor) for every color in 0..255
+const int CLARENDON_LIGHTEN_FACTOR = 19660;
+const int LIGHTEN_FACTOR = 52428;
+
+/**
+ * Scales a color value toward 0 using a fixed-point factor.
+ * Bit-exact with int(color * factor) in double for color in 0..255 when
+ * factor_fixed is one of the *_DARKEN_FACTOR constants.
+ * @param color        color value in 0..255
+ * @param factor_fixed scaling factor with FIXED_POINT_SHIFT fractional bits
+ * @return the scaled color value
+ */
+int darken_fixed(int color, int factor_fixed) {
+    return (color * factor_fixed) >> FIXED_POINT_SHIFT;
+};
+
+/**
+ * Scales a color value toward 255 using a fixed-point factor.
+ * Bit-exact with int(255 - (255 - color) * factor) in double for color in 0..255
+ * when factor_fixed is one of the *_LIGHTEN_FACTOR constants.
+ * @param color        color value in 0..255
+ * @param factor_fixed scaling factor with FIXED_POINT_SHIFT fractional bits
+ * @return the scaled color value
+ */
+int lighten_fixed(int color, int factor_fixed) {
+    return ((255 << FIXED_POINT_SHIFT) - (255 - color) * factor_fixed) >> FIXED_POINT_SHIFT;
+};
+
+/**
+ * A rectangular region of an image, measured in pixels from the top left corner
+ */
+struct Region
+{
+    int row;
+    int col;
+    int rows;
+    int cols;
+};
+
+/**
+ * Builds the region covering a whole image
+ * @param num_rows    image height in pixels
+ * @param num_columns image width in pixels
+ * @return the region starting at (0, 0) with the full image size
+ */
+Region full_region(int num_rows, int num_columns) {
+    Region region = {0, 0, num_rows, num_columns};
+    return region;
+};
+
 /**
  * Process 0: copy the image directly to the output file
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_0(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+template <typename Image>
+vector<vector<Pixel>> process_0(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
             //set each output pixel value to the input pixel value at vector index
             new_image[row][col].red = red_color;
@@ -264,18 +341,25 @@ vector<vector<Pixel>> process_0(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
+vector<vector<Pixel>> process_0(const vector<vector<Pixel>>& image) {
+    return process_0(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 1: Vignette
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_1(const vector<vector<Pixel>>& image) {
+template <typename Image>
+vector<vector<Pixel>> process_1(const Image& image, const Region& roi) {
+    //the vignette is centered on the whole image, not on the region
     int num_rows = image.size();
     int num_columns = image[0].size();
 
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = roi.row; row < roi.row + roi.rows; row++) {
+        for(int col = roi.col; col < roi.col + roi.cols; col++) {
             //find distance to center
             double distance = sqrt(pow((col - num_columns/2), 2) + pow((row - num_rows/2), 2));
             double scaling_factor = (num_columns - distance)/num_columns;
@@ -291,49 +375,51 @@ vector<vector<Pixel>> process_1(const vector<vector<Pixel>>& image) {
             double new_green = green_color * scaling_factor;
 
             //set each output pixel value to the input pixel value at vector index
-            new_image[row][col].red = new_red;
-            new_image[row][col].green = new_green;
-            new_image[row][col].blue = new_blue;
+            new_image[row - roi.row][col - roi.col].red = new_red;
+            new_image[row - roi.row][col - roi.col].green = new_green;
+            new_image[row - roi.row][col - roi.col].blue = new_blue;
         }
     }
     return new_image;
 };
 
+vector<vector<Pixel>> process_1(const vector<vector<Pixel>>& image) {
+    return process_1(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 2: Clarendon
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_2(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-    double scaling_factor = 0.3;
-
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+template <typename Image>
+vector<vector<Pixel>> process_2(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
             //calculate average of rgb values
-            double average_value = (red_color + blue_color + green_color)/3;
+            int average_value = (red_color + blue_color + green_color)/3;
 
-            //if the pixel is light, make it lighter
-            double new_red;
-            double new_blue;
-            double new_green;
+            //if the pixel is light, make it lighter; scaling factor is 0.3 in fixed point
+            int new_red;
+            int new_blue;
+            int new_green;
 
             if(average_value >= 170) {
-                new_red = int(255 - (255 - red_color)*scaling_factor);
-                new_blue =  int(255 - (255 - blue_color)*scaling_factor);
-                new_green = int(255 - (255 - green_color)*scaling_factor);
+                new_red = lighten_fixed(red_color, CLARENDON_LIGHTEN_FACTOR);
+                new_blue = lighten_fixed(blue_color, CLARENDON_LIGHTEN_FACTOR);
+                new_green = lighten_fixed(green_color, CLARENDON_LIGHTEN_FACTOR);
             }
             else if(average_value < 90) {
-                new_red = red_color * scaling_factor;
-                new_blue =  blue_color * scaling_factor;
-                new_green = green_color * scaling_factor;
+                new_red = darken_fixed(red_color, CLARENDON_DARKEN_FACTOR);
+                new_blue = darken_fixed(blue_color, CLARENDON_DARKEN_FACTOR);
+                new_green = darken_fixed(green_color, CLARENDON_DARKEN_FACTOR);
             }
             else{
                 new_red = red_color;
@@ -350,22 +436,25 @@ vector<vector<Pixel>> process_2(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
+vector<vector<Pixel>> process_2(const vector<vector<Pixel>>& image) {
+    return process_2(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 3: Grayscale
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_3(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+template <typename Image>
+vector<vector<Pixel>> process_3(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
             //average the pixel values
             double gray_value = (red_color + blue_color + green_color) / 3;
@@ -379,83 +468,142 @@ vector<vector<Pixel>> process_3(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
+vector<vector<Pixel>> process_3(const vector<vector<Pixel>>& image) {
+    return process_3(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 4: Rotate 90 degrees
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the rotated output image to compute
  */
-vector<vector<Pixel>> process_4(const vector<vector<Pixel>>& image) {
+template <typename Image>
+vector<vector<Pixel>> process_4(const Image& image, const Region& roi) {
     int num_rows = image.size();
-    int num_columns = image[0].size();
 
-    //transpose the number of rows and columns for the new image
-    vector<vector<Pixel>> new_image(num_columns, vector<Pixel>(num_rows));
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
+
+    for(int new_row = roi.row; new_row < roi.row + roi.rows; new_row++) {
+        for(int new_col = roi.col; new_col < roi.col + roi.cols; new_col++) {
+            //find the input pixel that rotates onto this output location
+            int row = (num_rows - 1) - new_col;
+            int col = new_row;
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
             //store each pixel value at vector index
             int red_color = image[row][col].red;
             int blue_color = image[row][col].blue;
             int green_color = image[row][col].green;
 
-            //adjust new pixel location
-            int new_col = (num_rows - 1) - row;
-            int new_row = col;
-
             //set each output pixel value to the input pixel value at vector index
-            new_image[new_row][new_col].red = red_color;
-            new_image[new_row][new_col].green = green_color;
-            new_image[new_row][new_col].blue = blue_color;
+            new_image[new_row - roi.row][new_col - roi.col].red = red_color;
+            new_image[new_row - roi.row][new_col - roi.col].green = green_color;
+            new_image[new_row - roi.row][new_col - roi.col].blue = blue_color;
         }
     }
     return new_image;
 };
 
+vector<vector<Pixel>> process_4(const vector<vector<Pixel>>& image) {
+    //transpose the number of rows and columns for the new image
+    return process_4(image, full_region(image[0].size(), image.size()));
+};
+
 /**
- * Process 5: Rotate multiple 90 degrees
- * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * Converts a number of 90 degree rotations into quarter turns in 0..3
+ * Negative numbers keep the original process_5 behavior of falling through to 270 degrees
+ * unless they land exactly on 0, 90 or 180.
+ * @param number number of 90 degree rotations requested
+ * @return number of clockwise quarter turns to apply
  */
-vector<vector<Pixel>> process_5(const vector<vector<Pixel>>& image, int number) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-
+int quarter_turns(int number) {
     int angle = number * 90;
 
-    //use process_4() to rotate the image 90 degrees
+    //angle must be a multiple of 90 degrees
     if(angle % 90 != 0) {
         cout << "angle must be a multiple of 90 degrees." << endl;
         exit(1);
     }
     else if(angle % 360 == 0) {
-        return image;
+        return 0;
     }
     else if(angle % 360 == 90) {
-        return process_4(image);
+        return 1;
     }
     else if(angle % 360 == 180) {
-        return process_4(process_4(image));
+        return 2;
     }
     else {
-        return process_4(process_4(process_4(image)));
+        return 3;
     }
 };
 
 /**
- * Process 6: Enlarge by scale x and scale y
+ * Process 5: Rotate multiple 90 degrees
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the rotated output image to compute
  */
-vector<vector<Pixel>> process_6(const vector<vector<Pixel>>& image, int x_scale, int y_scale) {
+template <typename Image>
+vector<vector<Pixel>> process_5(const Image& image, int number, const Region& roi) {
+    int num_rows = image.size();
+    int num_columns = image[0].size();
+    int turns = quarter_turns(number);
+
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
+
+    for(int new_row = roi.row; new_row < roi.row + roi.rows; new_row++) {
+        for(int new_col = roi.col; new_col < roi.col + roi.cols; new_col++) {
+            //find the input pixel that rotates onto this output location
+            int row = new_row;
+            int col = new_col;
+            if(turns == 1) {
+                row = (num_rows - 1) - new_col;
+                col = new_row;
+            }
+            else if(turns == 2) {
+                row = (num_rows - 1) - new_row;
+                col = (num_columns - 1) - new_col;
+            }
+            else if(turns == 3) {
+                row = new_col;
+                col = (num_columns - 1) - new_row;
+            }
+
+            //set each output pixel value to the input pixel value at vector index
+            new_image[new_row - roi.row][new_col - roi.col] = image[row][col];
+        }
+    }
+    return new_image;
+};
+
+vector<vector<Pixel>> process_5(const vector<vector<Pixel>>& image, int number) {
     int num_rows = image.size();
     int num_columns = image[0].size();
 
-    //scale the size for the new image
-    int new_num_rows = num_rows * y_scale;
-    int new_num_cols = num_columns * x_scale;
+    int turns = quarter_turns(number);
+    if(turns == 0) {
+        return image;
+    }
+    //odd numbers of quarter turns transpose the number of rows and columns
+    else if(turns % 2 == 1) {
+        return process_5(image, number, full_region(num_columns, num_rows));
+    }
+    else {
+        return process_5(image, number, full_region(num_rows, num_columns));
+    }
+};
 
-    //create the new image vector with the scaled size
-    vector<vector<Pixel>> new_image(new_num_rows, vector<Pixel>(new_num_cols));
+/**
+ * Process 6: Enlarge by scale x and scale y
+ * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the enlarged output image to compute
+ */
+template <typename Image>
+vector<vector<Pixel>> process_6(const Image& image, int x_scale, int y_scale, const Region& roi) {
+    //create the new image vector with the region size
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < (new_num_rows); row++) {
-        for(int col = 0; col < (new_num_cols); col++) {
+    for(int row = roi.row; row < roi.row + roi.rows; row++) {
+        for(int col = roi.col; col < roi.col + roi.cols; col++) {
             //intentionally truncate de-scaled pixel coordinates
             int de_scaled_row = row / y_scale;
             int de_scaled_col = col / x_scale;
@@ -466,30 +614,40 @@ vector<vector<Pixel>> process_6(const vector<vector<Pixel>>& image, int x_scale,
             int green_color = image[de_scaled_row][de_scaled_col].green;
 
             //set each output pixel value to the input pixel value at vector index
-            new_image[row][col].red = red_color;
-            new_image[row][col].blue = blue_color;
-            new_image[row][col].green = green_color;
+            new_image[row - roi.row][col - roi.col].red = red_color;
+            new_image[row - roi.row][col - roi.col].blue = blue_color;
+            new_image[row - roi.row][col - roi.col].green = green_color;
         }
     }
     return new_image;
 };
 
+vector<vector<Pixel>> process_6(const vector<vector<Pixel>>& image, int x_scale, int y_scale) {
+    int num_rows = image.size();
+    int num_columns = image[0].size();
+
+    //scale the size for the new image
+    int new_num_rows = num_rows * y_scale;
+    int new_num_cols = num_columns * x_scale;
+
+    return process_6(image, x_scale, y_scale, full_region(new_num_rows, new_num_cols));
+};
+
 /**
  * Process 7: High contrast, black and white
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_7(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+template <typename Image>
+vector<vector<Pixel>> process_7(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
             //average to get gray value
             double gray_color = (red_color + blue_color + green_color) / 3;
@@ -519,27 +677,30 @@ vector<vector<Pixel>> process_7(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
+vector<vector<Pixel>> process_7(const vector<vector<Pixel>>& image) {
+    return process_7(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 8: Lighten by scaling factor
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_8(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
+template <typename Image>
+vector<vector<Pixel>> process_8(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
-
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
-            double scaling_factor = .8;
-            int new_red = int(255 - (255 - red_color) * scaling_factor);
-            int new_blue = int(255 - (255 - blue_color) * scaling_factor);
-            int new_green = int(255 - (255 - green_color) * scaling_factor);
+            //scaling factor is 0.8 in fixed point
+            int new_red = lighten_fixed(red_color, LIGHTEN_FACTOR);
+            int new_blue = lighten_fixed(blue_color, LIGHTEN_FACTOR);
+            int new_green = lighten_fixed(green_color, LIGHTEN_FACTOR);
 
             //set each output pixel value to the input pixel value at vector index
             new_image[row][col].red = new_red;
@@ -550,27 +711,30 @@ vector<vector<Pixel>> process_8(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
+vector<vector<Pixel>> process_8(const vector<vector<Pixel>>& image) {
+    return process_8(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 9: Darken by scaling factor
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_9(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+template <typename Image>
+vector<vector<Pixel>> process_9(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
-            double scaling_factor = .8;
-            int new_red = red_color * scaling_factor;
-            int new_blue = blue_color * scaling_factor;
-            int new_green = green_color * scaling_factor;
+            //scaling factor is 0.8 in fixed point
+            int new_red = darken_fixed(red_color, DARKEN_FACTOR);
+            int new_blue = darken_fixed(blue_color, DARKEN_FACTOR);
+            int new_green = darken_fixed(green_color, DARKEN_FACTOR);
 
             //set each output pixel value to the input pixel value at vector index
             new_image[row][col].red = new_red;
@@ -581,22 +745,25 @@ vector<vector<Pixel>> process_9(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
+vector<vector<Pixel>> process_9(const vector<vector<Pixel>>& image) {
+    return process_9(image, full_region(image.size(), image[0].size()));
+};
+
 /**
  * Process 10: Convert to black, white, red, blue, and green
  * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
  */
-vector<vector<Pixel>> process_10(const vector<vector<Pixel>>& image) {
-    int num_rows = image.size();
-    int num_columns = image[0].size();
-
-    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+template <typename Image>
+vector<vector<Pixel>> process_10(const Image& image, const Region& roi) {
+    vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
 
-    for(int row = 0; row < num_rows; row++) {
-        for(int col = 0; col < num_columns; col++) {
+    for(int row = 0; row < roi.rows; row++) {
+        for(int col = 0; col < roi.cols; col++) {
             //store each pixel value at vector index
-            int red_color = image[row][col].red;
-            int blue_color = image[row][col].blue;
-            int green_color = image[row][col].green;
+            int red_color = image[roi.row + row][roi.col + col].red;
+            int blue_color = image[roi.row + row][roi.col + col].blue;
+            int green_color = image[roi.row + row][roi.col + col].green;
 
             int max_rb = max(red_color, blue_color);
             int max_color = max(max_rb, green_color);
@@ -640,76 +807,2070 @@ vector<vector<Pixel>> process_10(const vector<vector<Pixel>>& image) {
     return new_image;
 };
 
-//run the CLI for the image processing app
-void cli_process() {
+vector<vector<Pixel>> process_10(const vector<vector<Pixel>>& image) {
+    return process_10(image, full_region(image.size(), image[0].size()));
+};
 
-    //startup
-    cout << "CSPB 1300 Image Processing Application" << endl;
-    
-    //store input file name
-    string input_file;
-    
-    while(true) {
-        //verify input file exists
-        cout << "Enter input BMP filename: " << endl;
-        cin >> input_file;
-        ifstream file(input_file);
-        if(!file.good()) {
-            cout << "File does not exist, enter a .bmp path that exists." << endl;
+//destination tiles are this many pixels on each side when resampling
+const int RESAMPLE_TILE_SIZE = 64;
+
+/**
+ * A chain of rotations, flips and scales folded into one mapping from output to input pixels.
+ * Every step permutes or resamples whole rows and columns, so the combined mapping is kept as
+ * one lookup table per output axis plus a flag for whether the axes have been swapped. The
+ * output is then produced in a single pass with no intermediate images, and matches applying
+ * process_5 and process_6 one after another.
+ */
+class GeometricPipeline
+{
+public:
+    GeometricPipeline(int num_rows, int num_columns) : transposed(false), row_lut(num_rows), col_lut(num_columns) {
+        for(int row = 0; row < num_rows; row++) {
+            row_lut[row] = row;
         }
-        else {
-            break;
+        for(int col = 0; col < num_columns; col++) {
+            col_lut[col] = col;
         }
     }
 
-    //define to control loop, checking for 'Q'
-    string menu_selection;
+    int rows() const { return row_lut.size(); }
+    int cols() const { return col_lut.size(); }
+
+    /**
+     * Adds a clockwise rotation by multiple 90 degrees, like process_5
+     * @param number number of 90 degree rotations
+     */
+    void rotate(int number) {
+        for(int turn = 0; turn < quarter_turns(number); turn++) {
+            //new_image[row][col] = image[(num_rows - 1) - col][row], as in process_4
+            vector<int> new_row_lut = col_lut;
+            vector<int> new_col_lut(row_lut.rbegin(), row_lut.rend());
+            row_lut.swap(new_row_lut);
+            col_lut.swap(new_col_lut);
+            transposed = !transposed;
+        }
+    }
 
-    do{
-        //display CLI menu
-        cout << "IMAGE PROCESSING MENU" << endl;
-        cout << "0) Change image (current: " << input_file << ")" << endl;
-        cout << "1) Vignette" << endl;
-        cout << "2) Clarendon" << endl;
-        cout << "3) Grayscale" << endl;
-        cout << "4) Rotate 90 degrees" << endl;
-        cout << "5) Rotate multiple 90 degrees" << endl;
-        cout << "6) Enlarge" << endl;
-        cout << "7) High contrast" << endl;
-        cout << "8) Lighten" << endl;
-        cout << "9) Darken" << endl;
-        cout << "10) Black, white, red, green, blue" << endl;
+    /**
+     * Adds a mirror image across the vertical axis
+     */
+    void flip_horizontal() {
+        reverse(col_lut.begin(), col_lut.end());
+    }
 
-        cout << endl;
-        cout << "Enter menu selection (Q to quit): ";
+    /**
+     * Adds a mirror image across the horizontal axis
+     */
+    void flip_vertical() {
+        reverse(row_lut.begin(), row_lut.end());
+    }
 
-        //store menu selection
-        cin >> menu_selection;
+    /**
+     * Adds a nearest-neighbor scale by a fraction on each axis.
+     * New sizes and de-scaled coordinates are truncated, as in process_6; every factor must be
+     * positive and leave at least one pixel on each axis.
+     * @param x_numerator   horizontal scale numerator
+     * @param x_denominator horizontal scale denominator
+     * @param y_numerator   vertical scale numerator
+     * @param y_denominator vertical scale denominator
+     */
+    void scale(int x_numerator, int x_denominator, int y_numerator, int y_denominator) {
+        row_lut = scale_lut(row_lut, y_numerator, y_denominator);
+        col_lut = scale_lut(col_lut, x_numerator, x_denominator);
+    }
 
-        //quit interrupt
-        if(menu_selection == "Q") {
-            break;
+    /**
+     * Adds an enlarge by whole numbers on each axis, like process_6
+     * @param x_scale horizontal scale
+     * @param y_scale vertical scale
+     */
+    void enlarge(int x_scale, int y_scale) {
+        scale(x_scale, 1, y_scale, 1);
+    }
+
+    /**
+     * Maps a region of the output back to the input pixels it reads
+     * @param roi region of the output image
+     * @return the smallest input region covering every pixel the output region reads
+     */
+    Region source_region(const Region& roi) const {
+        int first_row = *min_element(row_lut.begin() + roi.row, row_lut.begin() + roi.row + roi.rows);
+        int last_row = *max_element(row_lut.begin() + roi.row, row_lut.begin() + roi.row + roi.rows);
+        int first_col = *min_element(col_lut.begin() + roi.col, col_lut.begin() + roi.col + roi.cols);
+        int last_col = *max_element(col_lut.begin() + roi.col, col_lut.begin() + roi.col + roi.cols);
+
+        Region source = {first_row, first_col, last_row - first_row + 1, last_col - first_col + 1};
+        if(transposed) {
+            Region swapped = {first_col, first_row, last_col - first_col + 1, last_row - first_row + 1};
+            source = swapped;
         }
+        return source;
+    }
 
-        //create the long names of processes for display after selection
-        string disp_selected;
-        switch(stoi(menu_selection)) {
-            case 1: disp_selected = "Vignette"; break;
-            case 2: disp_selected = "Clarendon"; break;
-            case 3: disp_selected = "Grayscale"; break;
-            case 4: disp_selected = "Rotate 90 degrees"; break;
-            case 5: disp_selected = "Rotate multiple 90 degrees"; break;
-            case 6: disp_selected = "Enlarge"; break;
-            case 7: disp_selected = "High contrast"; break;
-            case 8: disp_selected = "Lighten"; break;
-            case 9: disp_selected = "Darken"; break;
-            case 10: disp_selected = "Black, white, red, green, blue"; break;
+    /**
+     * Produces a region of the transformed image in one pass, walking the output in tiles
+     * so the input reads of a rotated image stay within a few cache lines per tile
+     * @param image the input image, in memory or memory-mapped
+     * @param roi   region of the transformed image to compute
+     * @return the output pixels inside roi
+     */
+    template <typename Image>
+    vector<vector<Pixel>> apply(const Image& image, const Region& roi) const {
+        vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
+
+        for(int tile_row = 0; tile_row < roi.rows; tile_row += RESAMPLE_TILE_SIZE) {
+            for(int tile_col = 0; tile_col < roi.cols; tile_col += RESAMPLE_TILE_SIZE) {
+                int row_end = min(tile_row + RESAMPLE_TILE_SIZE, roi.rows);
+                int col_end = min(tile_col + RESAMPLE_TILE_SIZE, roi.cols);
+
+                for(int row = tile_row; row < row_end; row++) {
+                    int row_source = row_lut[roi.row + row];
+                    for(int col = tile_col; col < col_end; col++) {
+                        int col_source = col_lut[roi.col + col];
+                        if(transposed) {
+                            new_image[row][col] = image[col_source][row_source];
+                        }
+                        else {
+                            new_image[row][col] = image[row_source][col_source];
+                        }
+                    }
+                }
+            }
         }
+        return new_image;
+    }
 
-        //receive menu_selection
-        //store output file name
-        cout << endl;
-        cout << disp_selected << " selected" << endl;
+    vector<vector<Pixel>> apply(const vector<vector<Pixel>>& image) const {
+        return apply(image, full_region(rows(), cols()));
+    }
+
+private:
+    static vector<int> scale_lut(const vector<int>& lut, int numerator, int denominator) {
+        //intentionally truncate de-scaled coordinates, as in process_6
+        vector<int> new_lut((long long)lut.size() * numerator / denominator);
+        for(size_t i = 0; i < new_lut.size(); i++) {
+            new_lut[i] = lut[(long long)i * denominator / numerator];
+        }
+        return new_lut;
+    }
+
+    bool transposed;
+    vector<int> row_lut;
+    vector<int> col_lut;
+};
+
+/**
+ * Builds the combined mapping for process 11 on an image of the given size
+ * @param number      number of 90 degree rotations
+ * @param x_scale     horizontal scale
+ * @param y_scale     vertical scale
+ * @param num_rows    input image height in pixels
+ * @param num_columns input image width in pixels
+ * @return the pipeline that rotates, then enlarges
+ */
+GeometricPipeline rotate_and_enlarge(int number, int x_scale, int y_scale, int num_rows, int num_columns) {
+    GeometricPipeline pipeline(num_rows, num_columns);
+    pipeline.rotate(number);
+    pipeline.enlarge(x_scale, y_scale);
+    return pipeline;
+};
+
+/**
+ * Process 11: Rotate multiple 90 degrees, then enlarge by scale x and scale y, in one pass
+ * Builds the pipeline on every call; tiled callers should use prepare_process() once instead.
+ * @param vector of the input BMP image as read by vector<vector<Pixel>> read_image(string filename)
+ * @param roi region of the output image to compute
+ */
+template <typename Image>
+vector<vector<Pixel>> process_11(const Image& image, int number, int x_scale, int y_scale, const Region& roi) {
+    return rotate_and_enlarge(number, x_scale, y_scale, image.size(), image[0].size()).apply(image, roi);
+};
+
+vector<vector<Pixel>> process_11(const vector<vector<Pixel>>& image, int number, int x_scale, int y_scale) {
+    return rotate_and_enlarge(number, x_scale, y_scale, image.size(), image[0].size()).apply(image);
+};
+
+/**
+ * The menu selection and user inputs needed to run one of the processes
+ */
+struct ProcessParams
+{
+    ProcessParams(int selection = 0, int number = 0, int x_scale = 1, int y_scale = 1)
+        : selection(selection), number(number), x_scale(x_scale), y_scale(y_scale) {}
+
+    int selection;
+    int number;
+    int x_scale;
+    int y_scale;
+
+    //process 11 mapping for one input size, built once per image by prepare_process()
+    shared_ptr<const GeometricPipeline> pipeline;
+};
+
+/**
+ * Does the per-image setup of a process once, so tile and chunk loops do not repeat it
+ * @param params      the process to run
+ * @param num_rows    input image height in pixels
+ * @param num_columns input image width in pixels
+ * @return the process settings to use for every region of this image
+ */
+ProcessParams prepare_process(const ProcessParams& params, int num_rows, int num_columns) {
+    ProcessParams prepared = params;
+    if(params.selection == 11) {
+        prepared.pipeline = make_shared<GeometricPipeline>(
+            rotate_and_enlarge(params.number, params.x_scale, params.y_scale, num_rows, num_columns));
+    }
+    return prepared;
+};
+
+/**
+ * Computes the size of the image a process will produce
+ * @param params      the process to run
+ * @param num_rows    input image height in pixels
+ * @param num_columns input image width in pixels
+ * @return the region covering the whole output image
+ */
+Region output_region(const ProcessParams& params, int num_rows, int num_columns) {
+    if(params.selection == 4 || (params.selection == 5 && quarter_turns(params.number) % 2 == 1)) {
+        return full_region(num_columns, num_rows);
+    }
+    else if(params.selection == 6) {
+        return full_region(num_rows * params.y_scale, num_columns * params.x_scale);
+    }
+    else if(params.selection == 11 && params.pipeline) {
+        return full_region(params.pipeline->rows(), params.pipeline->cols());
+    }
+    else if(params.selection == 11) {
+        return output_region(prepare_process(params, num_rows, num_columns), num_rows, num_columns);
+    }
+    return full_region(num_rows, num_columns);
+};
+
+/**
+ * Maps a region of a process output back to the input pixels it reads
+ * Color processes read the same region; rotations and enlarge read a moved or shrunk region.
+ * @param params      the process to run
+ * @param roi         region of the output image
+ * @param num_rows    input image height in pixels
+ * @param num_columns input image width in pixels
+ * @return the smallest input region covering every pixel the output region reads
+ */
+Region source_region(const ProcessParams& params, const Region& roi, int num_rows, int num_columns) {
+    if(params.selection == 11 && params.pipeline) {
+        return params.pipeline->source_region(roi);
+    }
+    else if(params.selection == 11) {
+        return source_region(prepare_process(params, num_rows, num_columns), roi, num_rows, num_columns);
+    }
+
+    int turns = 0;
+    if(params.selection == 4) {
+        turns = 1;
+    }
+    else if(params.selection == 5) {
+        turns = quarter_turns(params.number);
+    }
+
+    Region source = roi;
+    if(turns == 1) {
+        source.row = num_rows - roi.col - roi.cols;
+        source.col = roi.row;
+        source.rows = roi.cols;
+        source.cols = roi.rows;
+    }
+    else if(turns == 2) {
+        source.row = num_rows - roi.row - roi.rows;
+        source.col = num_columns - roi.col - roi.cols;
+    }
+    else if(turns == 3) {
+        source.row = roi.col;
+        source.col = num_columns - roi.row - roi.rows;
+        source.rows = roi.cols;
+        source.cols = roi.rows;
+    }
+    else if(params.selection == 6) {
+        //intentionally truncate de-scaled pixel coordinates, as process_6 does
+        source.row = roi.row / params.y_scale;
+        source.col = roi.col / params.x_scale;
+        source.rows = (roi.row + roi.rows - 1) / params.y_scale - source.row + 1;
+        source.cols = (roi.col + roi.cols - 1) / params.x_scale - source.col + 1;
+    }
+    return source;
+};
+
+/**
+ * Runs the selected process on one region of its output
+ * @param params the process to run
+ * @param image  the input image, in memory or memory-mapped
+ * @param roi    region of the output image to compute
+ * @return the output pixels inside roi
+ */
+template <typename Image>
+vector<vector<Pixel>> run_process(const ProcessParams& params, const Image& image, const Region& roi) {
+    switch(params.selection) {
+        case 1: return process_1(image, roi);
+        case 2: return process_2(image, roi);
+        case 3: return process_3(image, roi);
+        case 4: return process_4(image, roi);
+        case 5: return process_5(image, params.number, roi);
+        case 6: return process_6(image, params.x_scale, params.y_scale, roi);
+        case 7: return process_7(image, roi);
+        case 8: return process_8(image, roi);
+        case 9: return process_9(image, roi);
+        case 10: return process_10(image, roi);
+        case 11:
+            if(params.pipeline) {
+                return params.pipeline->apply(image, roi);
+            }
+            return process_11(image, params.number, params.x_scale, params.y_scale, roi);
+        default: return process_0(image, roi);
+    }
+};
+
+/**
+ * Runs the selected process on the whole image
+ * @param params the process to run
+ * @param image  the input image
+ * @return the processed image
+ */
+vector<vector<Pixel>> run_process(const ProcessParams& params, const vector<vector<Pixel>>& image) {
+    return run_process(params, image, output_region(params, image.size(), image[0].size()));
+};
+
+/**
+ * Counts the pixel data duplicated while running one job
+ */
+struct CopyCounter
+{
+    CopyCounter() : bytes(0), copies(0) {}
+
+    atomic<long long> bytes;
+    atomic<int> copies;
+};
+
+/**
+ * A reference-counted handle to an image that is only duplicated when written while shared.
+ * Copying a handle is O(1); write() gives the caller a private buffer, copying the pixels
+ * first if another handle still refers to them and recording the copy in the job's counter.
+ */
+class ImageHandle
+{
+public:
+    ImageHandle() : counter(new CopyCounter()) {}
+
+    ImageHandle(vector<vector<Pixel>> image, const shared_ptr<CopyCounter>& counter)
+        : pixels(make_shared<vector<vector<Pixel>>>(move(image))), counter(counter) {}
+
+    bool empty() const { return !pixels || pixels->empty(); }
+    bool shared() const { return pixels.use_count() > 1; }
+    const shared_ptr<CopyCounter>& copy_counter() const { return counter; }
+
+    /**
+     * Gets the pixels for reading without copying them
+     * @return the image pixels
+     */
+    const vector<vector<Pixel>>& read() const {
+        return *pixels;
+    }
+
+    /**
+     * Gets the pixels for writing, copying them first if another handle shares them
+     * @return the image pixels, owned by this handle alone
+     */
+    vector<vector<Pixel>>& write() {
+        if(shared()) {
+            pixels = make_shared<vector<vector<Pixel>>>(*pixels);
+            counter->bytes += (long long)pixels->size() * (*pixels)[0].size() * sizeof(Pixel);
+            counter->copies++;
+        }
+        return *pixels;
+    }
+
+private:
+    shared_ptr<vector<vector<Pixel>>> pixels;
+    shared_ptr<CopyCounter> counter;
+};
+
+/**
+ * Checks whether a process leaves the image exactly as it is
+ * @param params the process to run
+ * @return True for the copy, a rotation by a multiple of 360 degrees and an enlarge by 1
+ */
+bool is_pass_through(const ProcessParams& params) {
+    bool no_rotation = quarter_turns(params.number) == 0;
+    bool no_scale = params.x_scale == 1 && params.y_scale == 1;
+
+    return params.selection == 0 || (params.selection == 5 && no_rotation) || (params.selection == 6 && no_scale) ||
+        (params.selection == 11 && no_rotation && no_scale);
+};
+
+/**
+ * Checks whether each output pixel of a process only depends on the input pixel at the same place
+ * @param params the process to run
+ * @return True for the color processes
+ */
+bool is_point_process(const ProcessParams& params) {
+    return params.selection != 4 && params.selection != 5 && params.selection != 6 && params.selection != 11;
+};
+
+/**
+ * Process 0: copy the image directly to the output file, sharing the pixels instead of copying them
+ * @param image handle to the input image
+ */
+ImageHandle process_0(const ImageHandle& image) {
+    return image;
+};
+
+/**
+ * Runs the selected process on the whole image behind a handle.
+ * Pass-through processes return the same pixels in O(1). Color processes overwrite the
+ * pixels in place one row at a time, so they only pay for a copy when the input is shared;
+ * move the input handle in if the caller no longer needs it.
+ * @param params the process to run
+ * @param image  handle to the input image
+ * @return handle to the processed image
+ */
+ImageHandle run_process(const ProcessParams& params, ImageHandle image) {
+    if(is_pass_through(params)) {
+        return image;
+    }
+    else if(is_point_process(params)) {
+        vector<vector<Pixel>>& pixels = image.write();
+        int num_columns = pixels[0].size();
+        for(int row = 0; row < int(pixels.size()); row++) {
+            //each output row only reads the same input row, so it can replace it right away
+            Region row_region = {row, 0, 1, num_columns};
+            pixels[row].swap(run_process(params, pixels, row_region)[0]);
+        }
+        return image;
+    }
+    return ImageHandle(run_process(params, image.read()), image.copy_counter());
+};
+
+/**
+ * One row of an ImageWindow, indexed with the full image's column numbers
+ */
+struct WindowRow
+{
+    const Pixel* data;
+    int first_col;
+    int width;
+
+    size_t size() const { return width; }
+    const Pixel& operator[](int col) const { return data[col - first_col]; }
+};
+
+/**
+ * A copy of one region of a larger image, indexed with the larger image's coordinates.
+ * Only the pixels inside the region are read from the source. Every row still reports the
+ * full image width, so processes that depend on the image size see the same size.
+ */
+class ImageWindow
+{
+public:
+    template <typename Image>
+    ImageWindow(const Image& image, const Region& region)
+        : region(region), num_rows(image.size()), num_columns(image[0].size()),
+          pixels(region.rows, vector<Pixel>(region.cols))
+    {
+        for(int row = 0; row < region.rows; row++) {
+            for(int col = 0; col < region.cols; col++) {
+                pixels[row][col] = image[region.row + row][region.col + col];
+            }
+        }
+    }
+
+    size_t size() const { return num_rows; }
+
+    WindowRow operator[](int row) const {
+        //rows outside the region have no pixels, only a size
+        bool inside = row >= region.row && row < region.row + region.rows && region.cols > 0;
+        WindowRow result = {inside ? pixels[row - region.row].data() : NULL, region.col, num_columns};
+        return result;
+    }
+
+private:
+    Region region;
+    int num_rows;
+    int num_columns;
+    vector<vector<Pixel>> pixels;
+};
+
+/**
+ * A lazily evaluated view of a process output, split into square tiles.
+ * Tiles are only computed the first time a pixel inside them is requested and
+ * are cached afterwards, so looking at one part of a large image only pays for
+ * the tiles that cover it. Each tile only reads its source region from the input,
+ * which may be in memory or memory-mapped. The input image must outlive the view.
+ */
+template <typename Image>
+class TiledView
+{
+public:
+    TiledView(const Image& image, const ProcessParams& params, int tile_size)
+        : image(image), params(prepare_process(params, image.size(), image[0].size())), tile_size(tile_size)
+    {
+        output = output_region(this->params, image.size(), image[0].size());
+    }
+
+    int rows() const { return output.rows; }
+    int cols() const { return output.cols; }
+    int tiles_computed() const { return tiles.size(); }
+    int tile_rows() const { return (output.rows + tile_size - 1) / tile_size; }
+    int tile_cols() const { return (output.cols + tile_size - 1) / tile_size; }
+
+    /**
+     * Gets the output region covered by a tile, clipped to the output image
+     * @param tile_row tile index down the image
+     * @param tile_col tile index across the image
+     * @return the tile region in output coordinates
+     */
+    Region tile_region(int tile_row, int tile_col) const {
+        Region region = {tile_row * tile_size, tile_col * tile_size, tile_size, tile_size};
+        region.rows = min(tile_size, output.rows - region.row);
+        region.cols = min(tile_size, output.cols - region.col);
+        return region;
+    }
+
+    /**
+     * Gets the input region a tile reads from
+     * @param tile_row tile index down the image
+     * @param tile_col tile index across the image
+     * @return the tile's source region in input coordinates
+     */
+    Region tile_source_region(int tile_row, int tile_col) const {
+        return source_region(params, tile_region(tile_row, tile_col), image.size(), image[0].size());
+    }
+
+    /**
+     * Gets a tile of the output, computing it on first use
+     * @param tile_row tile index down the image
+     * @param tile_col tile index across the image
+     * @return the tile pixels
+     */
+    const vector<vector<Pixel>>& tile(int tile_row, int tile_col) {
+        pair<int, int> key(tile_row, tile_col);
+        typename map<pair<int, int>, vector<vector<Pixel>>>::iterator found = tiles.find(key);
+        if(found == tiles.end()) {
+            ImageWindow source(image, tile_source_region(tile_row, tile_col));
+            found = tiles.insert(make_pair(key, run_process(params, source, tile_region(tile_row, tile_col)))).first;
+        }
+        return found->second;
+    }
+
+    /**
+     * Drops a cached tile, for callers that only need each tile once
+     * @param tile_row tile index down the image
+     * @param tile_col tile index across the image
+     */
+    void evict(int tile_row, int tile_col) {
+        tiles.erase(make_pair(tile_row, tile_col));
+    }
+
+    /**
+     * Gets one output pixel
+     * @param row output row
+     * @param col output column
+     * @return the processed pixel
+     */
+    Pixel pixel(int row, int col) {
+        return tile(row / tile_size, col / tile_size)[row % tile_size][col % tile_size];
+    }
+
+    /**
+     * Gets a region of the output, computing only the tiles it overlaps
+     * @param roi region of the output image, clipped to the output size
+     * @return the output pixels inside roi
+     */
+    vector<vector<Pixel>> region(Region roi) {
+        int row_end = min(roi.row + roi.rows, output.rows);
+        int col_end = min(roi.col + roi.cols, output.cols);
+        roi.row = max(roi.row, 0);
+        roi.col = max(roi.col, 0);
+        roi.rows = max(row_end - roi.row, 0);
+        roi.cols = max(col_end - roi.col, 0);
+
+        vector<vector<Pixel>> new_image(roi.rows, vector<Pixel>(roi.cols));
+        for(int row = 0; row < roi.rows; row++) {
+            for(int col = 0; col < roi.cols; col++) {
+                new_image[row][col] = pixel(roi.row + row, roi.col + col);
+            }
+        }
+        return new_image;
+    }
+
+private:
+    const Image& image;
+    ProcessParams params;
+    int tile_size;
+    Region output;
+    map<pair<int, int>, vector<vector<Pixel>>> tiles;
+};
+
+//images whose decoded pixels would need more than this share of physical memory are processed out of core
+const double IN_MEMORY_FRACTION = 0.5;
+
+//output tiles are this many pixels on each side when processing out of core
+const int OUT_OF_CORE_TILE_SIZE = 256;
+
+const int BMP_HEADER_SIZE = 14;
+const int DIB_HEADER_SIZE = 40;
+
+/**
+ * BMP image properties, with every byte count and offset held in 64 bits
+ */
+struct BmpInfo
+{
+    long long file_size;
+    long long start;
+    int width;
+    int height;
+    int bits_per_pixel;
+    long long row_bytes;
+};
+
+/**
+ * Gets an unsigned little-endian integer from a binary stream using 64-bit offsets.
+ * Helper function for read_bmp_info()
+ * @param stream the stream
+ * @param offset the offset at which to read the integer
+ * @param bytes  the number of bytes to read
+ * @return the integer starting at the given offset
+ */
+long long get_int64(fstream& stream, long long offset, int bytes) {
+    stream.seekg(offset);
+    long long result = 0;
+    for(int i = 0; i < bytes; i++) {
+        result = result | ((long long)stream.get() << (i * 8));
+    }
+    return result;
+};
+
+/**
+ * Reads and validates the headers of a BMP file.
+ * Every file must be at least as long on disk as its headers say. The header file size
+ * field is only 32 bits wide, so files of 4 GB and up are only checked against their length on disk.
+ * @param filename BMP image filename
+ * @param info     set to the image properties
+ * @return True if the file is a BMP image this application can read and false otherwise
+ */
+bool read_bmp_info(string filename, BmpInfo& info) {
+    fstream stream;
+    stream.open(filename, ios::in | ios::binary);
+    if(!stream.is_open()) {
+        return false;
+    }
+
+    stream.seekg(0, ios::end);
+    long long actual_size = stream.tellg();
+    if(actual_size < BMP_HEADER_SIZE + DIB_HEADER_SIZE) {
+        return false;
+    }
+
+    info.file_size = get_int64(stream, 2, 4);
+    info.start = get_int64(stream, 10, 4);
+    info.width = get_int64(stream, 18, 4);
+    info.height = get_int64(stream, 22, 4);
+    info.bits_per_pixel = get_int64(stream, 28, 2);
+    stream.close();
+
+    if(info.width <= 0 || info.height <= 0 || info.bits_per_pixel < 24) {
+        return false;
+    }
+
+    //scan lines must occupy multiples of four bytes
+    long long scanline_size = (long long)info.width * (info.bits_per_pixel / 8);
+    info.row_bytes = scanline_size + (4 - scanline_size % 4) % 4;
+
+    //the pixels must really be on disk, or mapping and reading would run past the end of the file
+    long long expected_size = info.start + info.row_bytes * info.height;
+    if(actual_size < expected_size) {
+        return false;
+    }
+    if(expected_size <= 0xFFFFFFFFLL) {
+        return info.file_size == expected_size;
+    }
+    info.file_size = expected_size;
+    return true;
+};
+
+/**
+ * Reads the BMP image specified, one scan line at a time with 64-bit offsets
+ * @param filename BMP image filename
+ * @return the image as a vector of vector of Pixels, or an empty vector if it is not a valid image
+ */
+vector<vector<Pixel>> read_image_large(string filename) {
+    BmpInfo info;
+    if(!read_bmp_info(filename, info)) {
+        return {};
+    }
+
+    fstream stream;
+    stream.open(filename, ios::in | ios::binary);
+
+    vector<vector<Pixel>> image(info.height, vector<Pixel>(info.width));
+    vector<unsigned char> scanline(info.row_bytes);
+    int bytes_per_pixel = info.bits_per_pixel / 8;
+
+    //BMP files store rows from bottom to top and pixels in blue, green, red order
+    stream.seekg(info.start);
+    for(int row = info.height - 1; row >= 0; row--) {
+        stream.read((char*)scanline.data(), info.row_bytes);
+        for(int col = 0; col < info.width; col++) {
+            const unsigned char* pixel = &scanline[(long long)col * bytes_per_pixel];
+            image[row][col].blue = pixel[0];
+            image[row][col].green = pixel[1];
+            image[row][col].red = pixel[2];
+        }
+    }
+
+    stream.close();
+    return image;
+};
+
+/**
+ * Fills in the BMP and DIB headers for a 24-bit image.
+ * Size fields that do not fit in 32 bits are written as 0, which BMP readers accept
+ * for uncompressed images.
+ * @param header        array of BMP_HEADER_SIZE + DIB_HEADER_SIZE bytes to fill
+ * @param width_pixels  image width in pixels
+ * @param height_pixels image height in pixels
+ * @return the size of the whole file in bytes
+ */
+long long set_bmp_headers(unsigned char header[], int width_pixels, int height_pixels) {
+    long long width_bytes = (long long)width_pixels * 3;
+    width_bytes = width_bytes + (4 - width_bytes % 4) % 4;
+    long long array_bytes = width_bytes * height_pixels;
+    long long file_size = BMP_HEADER_SIZE + DIB_HEADER_SIZE + array_bytes;
+
+    unsigned char* dib_header = header + BMP_HEADER_SIZE;
+
+    //BMP header
+    set_bytes(header,  0, 1, 'B');
+    set_bytes(header,  1, 1, 'M');
+    set_bytes(header,  2, 4, file_size <= 0xFFFFFFFFLL ? file_size : 0);
+    set_bytes(header,  6, 2, 0);
+    set_bytes(header,  8, 2, 0);
+    set_bytes(header, 10, 4, BMP_HEADER_SIZE + DIB_HEADER_SIZE);
+
+    //DIB header
+    set_bytes(dib_header,  0, 4, DIB_HEADER_SIZE);
+    set_bytes(dib_header,  4, 4, width_pixels);
+    set_bytes(dib_header,  8, 4, height_pixels);
+    set_bytes(dib_header, 12, 2, 1);
+    set_bytes(dib_header, 14, 2, 24);
+    set_bytes(dib_header, 16, 4, 0);
+    set_bytes(dib_header, 20, 4, array_bytes <= 0xFFFFFFFFLL ? array_bytes : 0);
+    set_bytes(dib_header, 24, 4, 2835);
+    set_bytes(dib_header, 28, 4, 2835);
+    set_bytes(dib_header, 32, 4, 0);
+    set_bytes(dib_header, 36, 4, 0);
+
+    return file_size;
+};
+
+/**
+ * Write the input image to a BMP file, one scan line at a time with 64-bit sizes
+ * @param filename The BMP file name to save the image to
+ * @param image    The input image to save
+ * @return True if successful and false otherwise
+ */
+bool write_image_large(string filename, const vector<vector<Pixel>>& image) {
+    int width_pixels = image[0].size();
+    int height_pixels = image.size();
+
+    fstream stream;
+    stream.open(filename, ios::out | ios::binary);
+    if(!stream.is_open()) {
+        return false;
+    }
+
+    unsigned char header[BMP_HEADER_SIZE + DIB_HEADER_SIZE] = {0};
+    set_bmp_headers(header, width_pixels, height_pixels);
+    stream.write((char*)header, sizeof(header));
+
+    //padding bytes stay zero at the end of the scan line
+    long long width_bytes = (long long)width_pixels * 3;
+    vector<unsigned char> scanline(width_bytes + (4 - width_bytes % 4) % 4, 0);
+
+    //pixel array (left to right, bottom to top, with padding)
+    for(int row = height_pixels - 1; row >= 0; row--) {
+        for(int col = 0; col < width_pixels; col++) {
+            unsigned char* pixel = &scanline[(long long)col * 3];
+            pixel[0] = image[row][col].blue;
+            pixel[1] = image[row][col].green;
+            pixel[2] = image[row][col].red;
+        }
+        stream.write((char*)scanline.data(), scanline.size());
+    }
+
+    stream.close();
+    return !stream.fail();
+};
+
+/**
+ * Reads a downsampled copy of the BMP image specified, keeping one pixel in factor along each axis.
+ * Only the scan lines that are kept are read from the file.
+ * @param filename BMP image filename
+ * @param factor   how many input pixels each preview pixel stands for along each axis
+ * @return the decimated image, or an empty vector if it is not a valid image
+ */
+vector<vector<Pixel>> read_image_decimated(string filename, int factor) {
+    BmpInfo info;
+    if(!read_bmp_info(filename, info)) {
+        return {};
+    }
+
+    fstream stream;
+    stream.open(filename, ios::in | ios::binary);
+
+    int num_rows = (info.height + factor - 1) / factor;
+    int num_columns = (info.width + factor - 1) / factor;
+    vector<vector<Pixel>> image(num_rows, vector<Pixel>(num_columns));
+    vector<unsigned char> scanline(info.row_bytes);
+    int bytes_per_pixel = info.bits_per_pixel / 8;
+
+    for(int row = 0; row < num_rows; row++) {
+        //BMP files store rows from bottom to top
+        long long source_row = info.height - 1 - (long long)row * factor;
+        stream.seekg(info.start + source_row * info.row_bytes);
+        stream.read((char*)scanline.data(), info.row_bytes);
+        for(int col = 0; col < num_columns; col++) {
+            const unsigned char* pixel = &scanline[(long long)col * factor * bytes_per_pixel];
+            image[row][col].blue = pixel[0];
+            image[row][col].green = pixel[1];
+            image[row][col].red = pixel[2];
+        }
+    }
+
+    stream.close();
+    return image;
+};
+
+/**
+ * One scan line of a memory-mapped BMP image, indexed like a vector<Pixel>
+ */
+struct MappedRow
+{
+    const unsigned char* data;
+    int width;
+    int bytes_per_pixel;
+
+    size_t size() const { return width; }
+
+    Pixel operator[](int col) const {
+        const unsigned char* pixel = data + (long long)col * bytes_per_pixel;
+        Pixel result = {pixel[2], pixel[1], pixel[0]};
+        return result;
+    }
+};
+
+/**
+ * A BMP image backed by a memory-mapped file instead of a vector<vector<Pixel>>.
+ * Indexing works like the in-memory image, so the region versions of the process
+ * functions can read from it directly; the operating system pages pixels in and
+ * out as tiles touch them, so the image may be larger than RAM.
+ */
+class MappedImage
+{
+public:
+    MappedImage() : fd(-1), data(NULL), length(0) {}
+    ~MappedImage() { close(); }
+
+    /**
+     * Maps an existing BMP file for reading
+     * @param filename BMP image filename
+     * @return True if successful and false otherwise
+     */
+    bool open(string filename) {
+        if(!read_bmp_info(filename, info)) {
+            return false;
+        }
+        fd = ::open(filename.c_str(), O_RDONLY);
+        return fd >= 0 && map(PROT_READ);
+    }
+
+    /**
+     * Creates a 24-bit BMP file of the given size and maps it for writing
+     * @param filename      The BMP file name to save the image to
+     * @param height_pixels image height in pixels
+     * @param width_pixels  image width in pixels
+     * @return True if successful and false otherwise
+     */
+    bool create(string filename, int height_pixels, int width_pixels) {
+        unsigned char header[BMP_HEADER_SIZE + DIB_HEADER_SIZE] = {0};
+        info.file_size = set_bmp_headers(header, width_pixels, height_pixels);
+        info.start = BMP_HEADER_SIZE + DIB_HEADER_SIZE;
+        info.width = width_pixels;
+        info.height = height_pixels;
+        info.bits_per_pixel = 24;
+        info.row_bytes = (info.file_size - info.start) / height_pixels;
+
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0 || ftruncate(fd, info.file_size) != 0) {
+            return false;
+        }
+        if(!map(PROT_READ | PROT_WRITE)) {
+            return false;
+        }
+        memcpy(data, header, sizeof(header));
+        return true;
+    }
+
+    size_t size() const { return info.height; }
+
+    MappedRow operator[](int row) const {
+        //BMP files store rows from bottom to top
+        MappedRow result = {data + info.start + (info.height - 1 - row) * info.row_bytes, info.width, info.bits_per_pixel / 8};
+        return result;
+    }
+
+    /**
+     * Copies processed pixels into a region of a writable mapping
+     * @param roi    region of the image to fill
+     * @param pixels roi.rows by roi.cols pixels
+     */
+    void write_region(const Region& roi, const vector<vector<Pixel>>& pixels) {
+        for(int row = 0; row < roi.rows; row++) {
+            unsigned char* pixel = (unsigned char*)(*this)[roi.row + row].data + (long long)roi.col * 3;
+            for(int col = 0; col < roi.cols; col++) {
+                pixel[0] = pixels[row][col].blue;
+                pixel[1] = pixels[row][col].green;
+                pixel[2] = pixels[row][col].red;
+                pixel = pixel + 3;
+            }
+        }
+    }
+
+    /**
+     * Flushes any written pixels and unmaps the file
+     * @return True if the pixels reached the file and false otherwise
+     */
+    bool close() {
+        bool success = true;
+        if(data != NULL) {
+            success = msync(data, length, MS_SYNC) == 0;
+            munmap(data, length);
+            data = NULL;
+        }
+        if(fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        return success;
+    }
+
+private:
+    bool map(int protection) {
+        length = info.file_size;
+        void* mapped = mmap(NULL, length, protection, MAP_SHARED, fd, 0);
+        if(mapped == MAP_FAILED) {
+            return false;
+        }
+        data = (unsigned char*)mapped;
+        return true;
+    }
+
+    //the mapping owns a file descriptor, so it cannot be copied
+    MappedImage(const MappedImage&);
+    MappedImage& operator=(const MappedImage&);
+
+    int fd;
+    unsigned char* data;
+    long long length;
+    BmpInfo info;
+};
+
+/**
+ * Runs the selected process from one BMP file to another without holding either image in memory.
+ * The output is produced one tile at a time through a TiledView; each tile only reads the input
+ * region it maps back to, which lets the rotations work on images that cannot be streamed row by row.
+ * @param input_file  BMP image filename to read
+ * @param output_file BMP image filename to write
+ * @param params      the process to run
+ * @param tile_size   output tile size in pixels
+ * @return True if successful and false otherwise
+ */
+bool process_out_of_core(string input_file, string output_file, const ProcessParams& params, int tile_size) {
+    MappedImage input;
+    if(!input.open(input_file)) {
+        return false;
+    }
+
+    TiledView<MappedImage> view(input, params, tile_size);
+    MappedImage output;
+    if(!output.create(output_file, view.rows(), view.cols())) {
+        return false;
+    }
+
+    //each tile is written once, so it is dropped from the view right away
+    for(int tile_row = 0; tile_row < view.tile_rows(); tile_row++) {
+        for(int tile_col = 0; tile_col < view.tile_cols(); tile_col++) {
+            output.write_region(view.tile_region(tile_row, tile_col), view.tile(tile_row, tile_col));
+            view.evict(tile_row, tile_col);
+        }
+    }
+    return output.close();
+};
+
+/**
+ * Gets how much memory decoded images may take in total
+ * @return IN_MEMORY_FRACTION of physical memory, in bytes
+ */
+long long in_memory_budget() {
+    long long physical_bytes = (long long)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+    return physical_bytes * IN_MEMORY_FRACTION;
+};
+
+/**
+ * Estimates the memory needed to decode an image into a vector<vector<Pixel>> and process it.
+ * Decoded pixels take sizeof(Pixel) bytes each against 3 in the file, and every process except
+ * the pass-throughs needs a full output image as well, so the estimate covers both.
+ * @param info   properties of the input BMP file
+ * @param params the process to run
+ * @return the decoded input and output size in bytes
+ */
+long long decoded_bytes(const BmpInfo& info, const ProcessParams& params) {
+    Region output = output_region(params, info.height, info.width);
+    return ((long long)info.height * info.width + (long long)output.rows * output.cols) * sizeof(Pixel);
+};
+
+/**
+ * Decides whether an image can be decoded and processed in memory, on its own
+ * @param info   properties of the input BMP file
+ * @param params the process to run
+ * @return True if the decoded input and output fit in IN_MEMORY_FRACTION of physical memory
+ */
+bool fits_in_memory(const BmpInfo& info, const ProcessParams& params) {
+    return decoded_bytes(info, params) <= in_memory_budget();
+};
+
+/**
+ * A share of in_memory_budget() held by one image while it is decoded in memory, so
+ * images processed side by side never decode more than the budget between them.
+ * The share is given back when the reservation goes out of scope.
+ */
+class MemoryReservation
+{
+public:
+    /**
+     * Reserves memory if the budget still has room for it
+     * @param bytes memory the image needs
+     */
+    MemoryReservation(long long bytes) : bytes(bytes), held(false) {
+        lock_guard<mutex> lock(reserved_lock);
+        if(reserved_bytes + bytes <= in_memory_budget()) {
+            reserved_bytes += bytes;
+            held = true;
+        }
+    }
+
+    ~MemoryReservation() {
+        if(held) {
+            lock_guard<mutex> lock(reserved_lock);
+            reserved_bytes -= bytes;
+        }
+    }
+
+    bool granted() const { return held; }
+
+private:
+    MemoryReservation(const MemoryReservation&);
+    MemoryReservation& operator=(const MemoryReservation&);
+
+    long long bytes;
+    bool held;
+
+    //memory reserved by every image being processed in memory; guarded by reserved_lock
+    static mutex reserved_lock;
+    static long long reserved_bytes;
+};
+
+mutex MemoryReservation::reserved_lock;
+long long MemoryReservation::reserved_bytes = 0;
+
+//each batch worker may have this many bytes of decoded images in flight, up to in_memory_budget() in total
+const long long BATCH_WORKER_MEMORY_BYTES = 256LL << 20;
+
+//row chunks are sized to about this many output pixels so idle workers have something to steal
+const long long BATCH_CHUNK_PIXELS = 1 << 18;
+
+/**
+ * One image of a batch, shared by the row chunk tasks that process it
+ */
+struct BatchJob
+{
+    string input_file;
+    string output_file;
+    BmpInfo info;
+    long long memory_bytes;
+    bool out_of_core;
+    ProcessParams params;
+    shared_ptr<CopyCounter> copies;
+
+    //why the image was skipped, if it was rejected before processing
+    string error;
+
+    //filled in when the image is decoded
+    ImageHandle input_image;
+    ImageHandle output_image;
+    const vector<vector<Pixel>>* source_pixels;
+    vector<vector<Pixel>>* output_pixels;
+    MappedImage input_map;
+    MappedImage output_map;
+    Region output;
+    atomic<int> chunks_left;
+    bool success;
+};
+
+/**
+ * A pool of workers that each own a deque of tasks.
+ * Workers take their own newest task first and steal the oldest task of another worker
+ * when they run dry, so the row chunks of one large image spread over every idle core.
+ */
+class WorkStealingScheduler
+{
+public:
+    WorkStealingScheduler(int num_workers) : queues(num_workers) {}
+
+    int workers() const { return queues.size(); }
+
+    /**
+     * Adds a task to a worker's own deque
+     * @param worker index of the worker
+     * @param task   work to run; receives the index of the worker running it
+     */
+    void push(int worker, const function<void(int)>& task) {
+        lock_guard<mutex> lock(queues[worker].lock);
+        queues[worker].tasks.push_back(task);
+    }
+
+    /**
+     * Takes the next task for a worker, stealing from the others if its own deque is empty
+     * @param worker index of the worker
+     * @param task   set to the task found
+     * @return True if a task was found and false otherwise
+     */
+    bool pop(int worker, function<void(int)>& task) {
+        {
+            lock_guard<mutex> lock(queues[worker].lock);
+            if(!queues[worker].tasks.empty()) {
+                task = queues[worker].tasks.back();
+                queues[worker].tasks.pop_back();
+                return true;
+            }
+        }
+        for(int offset = 1; offset < workers(); offset++) {
+            WorkerQueue& victim = queues[(worker + offset) % workers()];
+            lock_guard<mutex> lock(victim.lock);
+            if(!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct WorkerQueue
+    {
+        mutex lock;
+        deque<function<void(int)>> tasks;
+    };
+
+    vector<WorkerQueue> queues;
+};
+
+/**
+ * Runs one process over many images on every core.
+ * Images are decoded largest first as long as the decoded pixels fit in the memory budget of
+ * all workers together; an image bigger than the whole budget still runs, but only on its own.
+ * Each decoded image is split into row chunks that any worker may steal, and the worker that
+ * finishes the last chunk writes the image and frees its memory.
+ */
+class BatchRunner
+{
+public:
+    BatchRunner(const ProcessParams& params, int num_workers)
+        : params(params), scheduler(num_workers), memory_budget(min(BATCH_WORKER_MEMORY_BYTES * num_workers, in_memory_budget())),
+          memory_in_use(0), jobs_in_flight(0), jobs_left(0), work_generation(0) {}
+
+    /**
+     * Adds an image to the batch
+     * @param input_file  BMP image filename to read
+     * @param output_file BMP image filename to write
+     * @param error       reason to report the image as failed without processing it, or empty
+     */
+    void add(string input_file, string output_file, string error) {
+        shared_ptr<BatchJob> job(new BatchJob());
+        job->input_file = input_file;
+        job->output_file = output_file;
+        job->error = error;
+        job->success = error.empty() && read_bmp_info(input_file, job->info);
+        if(job->success) {
+            job->params = prepare_process(params, job->info.height, job->info.width);
+        }
+        job->out_of_core = job->success && !fits_in_memory(job->info, job->params);
+        job->copies.reset(new CopyCounter());
+        job->memory_bytes = 0;
+        if(job->success && !job->out_of_core) {
+            //color processes and pass-throughs reuse the input pixels for the output
+            long long output_pixels = 0;
+            if(!is_pass_through(params) && !is_point_process(params)) {
+                Region output = output_region(job->params, job->info.height, job->info.width);
+                output_pixels = (long long)output.rows * output.cols;
+            }
+            job->memory_bytes = ((long long)job->info.height * job->info.width + output_pixels) * sizeof(Pixel);
+        }
+        jobs.push_back(job);
+    }
+
+    /**
+     * Processes every image added and waits for the workers to finish
+     * @return the images in the order they were added, with their success flags set
+     */
+    const vector<shared_ptr<BatchJob>>& run() {
+        for(size_t i = 0; i < jobs.size(); i++) {
+            if(jobs[i]->success) {
+                pending.push_back(jobs[i]);
+            }
+        }
+        //start the biggest images first so they do not hold up the tail of the batch
+        sort(pending.begin(), pending.end(), larger_job);
+        jobs_left = pending.size();
+
+        vector<thread> threads;
+        for(int worker = 0; worker < scheduler.workers(); worker++) {
+            threads.push_back(thread(&BatchRunner::work, this, worker));
+        }
+        for(size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        return jobs;
+    }
+
+private:
+    static bool larger_job(const shared_ptr<BatchJob>& a, const shared_ptr<BatchJob>& b) {
+        return a->info.file_size > b->info.file_size;
+    }
+
+    void work(int worker) {
+        function<void(int)> task;
+        while(jobs_left > 0) {
+            //note the generation before looking, so work queued meanwhile is not slept through
+            long long seen;
+            {
+                lock_guard<mutex> lock(idle_lock);
+                seen = work_generation;
+            }
+            if(scheduler.pop(worker, task)) {
+                task(worker);
+            }
+            else if(!start_next_job(worker)) {
+                unique_lock<mutex> lock(idle_lock);
+                work_available.wait(lock, [this, seen]() { return work_generation != seen || jobs_left == 0; });
+            }
+        }
+    }
+
+    /**
+     * Wakes idle workers after chunks are queued or an image finishes and frees its memory
+     */
+    void notify_workers() {
+        {
+            lock_guard<mutex> lock(idle_lock);
+            work_generation++;
+        }
+        work_available.notify_all();
+    }
+
+    /**
+     * Decodes the next image that fits in the memory budget and queues its row chunks
+     * @param worker index of the worker doing the decode
+     * @return True if an image was started and false otherwise
+     */
+    bool start_next_job(int worker) {
+        shared_ptr<BatchJob> job;
+        {
+            lock_guard<mutex> lock(budget_lock);
+            for(size_t i = 0; i < pending.size(); i++) {
+                if(memory_in_use + pending[i]->memory_bytes <= memory_budget || jobs_in_flight == 0) {
+                    job = pending[i];
+                    pending.erase(pending.begin() + i);
+                    memory_in_use += job->memory_bytes;
+                    jobs_in_flight++;
+                    break;
+                }
+            }
+        }
+        if(!job) {
+            return false;
+        }
+
+        if(job->out_of_core) {
+            Region input_size = full_region(job->info.height, job->info.width);
+            job->output = output_region(job->params, input_size.rows, input_size.cols);
+            job->success = job->input_map.open(job->input_file) && job->output_map.create(job->output_file, job->output.rows, job->output.cols);
+        }
+        else {
+            job->input_image = ImageHandle(read_image_large(job->input_file), job->copies);
+            job->success = !job->input_image.empty();
+            if(job->success && is_pass_through(params)) {
+                //nothing to compute; the output shares the input pixels
+                job->success = write_image_large(job->output_file, process_0(job->input_image).read());
+                finish_job(job);
+                return true;
+            }
+            else if(job->success && is_point_process(params)) {
+                //color processes overwrite the pixels in place, so the input becomes the output
+                job->output = full_region(job->info.height, job->info.width);
+                swap(job->input_image, job->output_image);
+            }
+            else if(job->success) {
+                job->output = output_region(job->params, job->info.height, job->info.width);
+                job->output_image = ImageHandle(vector<vector<Pixel>>(job->output.rows, vector<Pixel>(job->output.cols)), job->copies);
+            }
+        }
+        if(!job->success) {
+            finish_job(job);
+            return true;
+        }
+
+        //take write access once, before any chunk runs, so chunks never copy or detach the output
+        if(!job->out_of_core) {
+            job->output_pixels = &job->output_image.write();
+            job->source_pixels = is_point_process(params) ? job->output_pixels : &job->input_image.read();
+        }
+
+        //split the output into chunks; the last one to finish writes the image
+        vector<Region> chunks;
+        if(job->out_of_core) {
+            //square tiles keep the mapped input reads of a rotation to a compact region, like TiledView
+            for(int row = 0; row < job->output.rows; row += OUT_OF_CORE_TILE_SIZE) {
+                for(int col = 0; col < job->output.cols; col += OUT_OF_CORE_TILE_SIZE) {
+                    Region chunk = {row, col, min(OUT_OF_CORE_TILE_SIZE, job->output.rows - row), min(OUT_OF_CORE_TILE_SIZE, job->output.cols - col)};
+                    chunks.push_back(chunk);
+                }
+            }
+        }
+        else {
+            int chunk_rows = max(1LL, BATCH_CHUNK_PIXELS / job->output.cols);
+            for(int row = 0; row < job->output.rows; row += chunk_rows) {
+                Region chunk = {row, 0, min(chunk_rows, job->output.rows - row), job->output.cols};
+                chunks.push_back(chunk);
+            }
+        }
+        job->chunks_left = chunks.size();
+        for(size_t i = 0; i < chunks.size(); i++) {
+            Region chunk = chunks[i];
+            scheduler.push(worker, [this, job, chunk](int) { run_chunk(job, chunk); });
+        }
+        notify_workers();
+        return true;
+    }
+
+    void run_chunk(const shared_ptr<BatchJob>& job, const Region& chunk) {
+        if(job->out_of_core) {
+            //copy the tile's source region out of the mapping once instead of striding across it
+            ImageWindow source(job->input_map, source_region(job->params, chunk, job->info.height, job->info.width));
+            job->output_map.write_region(chunk, run_process(job->params, source, chunk));
+        }
+        else {
+            //copy pixel values rather than swapping rows, since other chunks may be reading the same image
+            vector<vector<Pixel>> pixels = run_process(job->params, *job->source_pixels, chunk);
+            for(int row = 0; row < chunk.rows; row++) {
+                copy(pixels[row].begin(), pixels[row].end(), (*job->output_pixels)[chunk.row + row].begin());
+            }
+        }
+
+        if(--job->chunks_left == 0) {
+            if(job->out_of_core) {
+                job->input_map.close();
+                job->success = job->output_map.close();
+            }
+            else {
+                job->success = write_image_large(job->output_file, job->output_image.read());
+            }
+            finish_job(job);
+        }
+    }
+
+    void finish_job(const shared_ptr<BatchJob>& job) {
+        //release the decoded pixels before giving their memory back to the budget
+        job->input_image = ImageHandle();
+        job->output_image = ImageHandle();
+
+        {
+            lock_guard<mutex> lock(budget_lock);
+            memory_in_use -= job->memory_bytes;
+            jobs_in_flight--;
+            jobs_left--;
+        }
+        notify_workers();
+    }
+
+    ProcessParams params;
+    WorkStealingScheduler scheduler;
+    vector<shared_ptr<BatchJob>> jobs;
+
+    //guarded by budget_lock
+    mutex budget_lock;
+    vector<shared_ptr<BatchJob>> pending;
+    long long memory_budget;
+    long long memory_in_use;
+    int jobs_in_flight;
+    atomic<int> jobs_left;
+
+    //idle workers sleep until work_generation changes; guarded by idle_lock
+    mutex idle_lock;
+    condition_variable work_available;
+    long long work_generation;
+};
+
+/**
+ * Lists the BMP images to process in batch mode
+ * @param source a directory of BMP images, or a manifest file with one BMP filename per line
+ * @param inputs set to the BMP filenames
+ * @return True if the directory or manifest could be read and false otherwise
+ */
+bool batch_inputs(string source, vector<string>& inputs) {
+    struct stat source_stat;
+    if(stat(source.c_str(), &source_stat) == 0 && S_ISDIR(source_stat.st_mode)) {
+        DIR* directory = opendir(source.c_str());
+        if(directory == NULL) {
+            return false;
+        }
+        while(dirent* entry = readdir(directory)) {
+            string name = entry->d_name;
+            if(name.size() > 4 && (name.substr(name.size() - 4) == ".bmp" || name.substr(name.size() - 4) == ".BMP")) {
+                inputs.push_back(source + "/" + name);
+            }
+        }
+        closedir(directory);
+        sort(inputs.begin(), inputs.end());
+    }
+    else {
+        ifstream manifest(source);
+        if(!manifest.is_open()) {
+            return false;
+        }
+        string line;
+        while(getline(manifest, line)) {
+            if(!line.empty() && line[0] != '#') {
+                inputs.push_back(line);
+            }
+        }
+    }
+    return true;
+};
+
+/**
+ * Reads a whole command line argument as an integer
+ * @param text  the argument
+ * @param value set to the integer if the argument is one
+ * @return True if the whole argument is an integer and false otherwise
+ */
+bool parse_number(const char* text, int& value) {
+    char* end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if(*text == '\0' || *end != '\0' || errno != 0 || number < INT_MIN || number > INT_MAX) {
+        return false;
+    }
+    value = number;
+    return true;
+};
+
+/**
+ * Runs one process over a directory or manifest of BMP images
+ * Usage: main --batch <directory or manifest> <output directory> <selection> [rotations] [x scale] [y scale]
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @return 0 if every image was processed and 1 otherwise
+ */
+int batch_process(int argc, char* argv[]) {
+    //each selection takes the inputs the menu would ask for, and nothing else
+    ProcessParams params = {0, 0, 1, 1};
+    int expected_args = 0;
+    bool valid = argc >= 5 && parse_number(argv[4], params.selection) && params.selection >= 0 && params.selection <= 11;
+    if(valid) {
+        expected_args = params.selection == 5 ? 1 : params.selection == 6 ? 2 : params.selection == 11 ? 3 : 0;
+        valid = argc == 5 + expected_args;
+    }
+    if(valid && (params.selection == 5 || params.selection == 11)) {
+        valid = parse_number(argv[5], params.number);
+    }
+    if(valid && (params.selection == 6 || params.selection == 11)) {
+        valid = parse_number(argv[argc - 2], params.x_scale) && parse_number(argv[argc - 1], params.y_scale) &&
+            params.x_scale >= 1 && params.y_scale >= 1;
+    }
+    if(!valid) {
+        cout << "Usage: " << argv[0] << " --batch <directory or manifest> <output directory> <selection> [rotations] [x scale] [y scale]" << endl;
+        cout << "Selection 5 takes rotations, 6 takes x and y scales of at least 1, and 11 takes all three." << endl;
+        return 1;
+    }
+
+    string output_directory = argv[3];
+    int num_workers = max(1u, thread::hardware_concurrency());
+    BatchRunner runner(params, num_workers);
+
+    vector<string> inputs;
+    if(!batch_inputs(argv[2], inputs)) {
+        cout << "Could not open " << argv[2] << " as a directory or manifest of BMP images." << endl;
+        return 1;
+    }
+    vector<string> names;
+    map<string, int> name_counts;
+    vector<struct stat> input_stats;
+    for(size_t i = 0; i < inputs.size(); i++) {
+        names.push_back(inputs[i].substr(inputs[i].find_last_of('/') + 1));
+        name_counts[names[i]]++;
+
+        struct stat input_stat;
+        if(stat(inputs[i].c_str(), &input_stat) == 0) {
+            input_stats.push_back(input_stat);
+        }
+    }
+
+    for(size_t i = 0; i < inputs.size(); i++) {
+        string output_file = output_directory + "/" + names[i];
+        string error;
+
+        //outputs must never replace an input, and two inputs must not share an output
+        struct stat output_stat;
+        if(name_counts[names[i]] > 1) {
+            error = "another input has the same file name";
+        }
+        else if(stat(output_file.c_str(), &output_stat) == 0) {
+            for(size_t j = 0; j < input_stats.size(); j++) {
+                if(input_stats[j].st_dev == output_stat.st_dev && input_stats[j].st_ino == output_stat.st_ino) {
+                    error = "output would overwrite an input";
+                }
+            }
+        }
+        runner.add(inputs[i], output_file, error);
+    }
+
+    const vector<shared_ptr<BatchJob>>& jobs = runner.run();
+
+    int failures = 0;
+    for(size_t i = 0; i < jobs.size(); i++) {
+        if(jobs[i]->success) {
+            cout << "Wrote " << jobs[i]->output_file << ", copied " << jobs[i]->copies->bytes << " bytes of pixel data" << endl;
+        }
+        else if(!jobs[i]->error.empty()) {
+            cout << "Failed " << jobs[i]->input_file << ": " << jobs[i]->error << endl;
+            failures++;
+        }
+        else {
+            cout << "Failed " << jobs[i]->input_file << endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+};
+
+//inputs bigger than this get a decimated preview written before the full resolution result
+const long long PREVIEW_BYTES = 16LL << 20;
+
+//the preview keeps one pixel in this many along each axis
+const int PREVIEW_FACTOR = 8;
+
+/**
+ * Runs the selected process at full resolution from one BMP file to another, in memory
+ * or out of core depending on the input size and the memory other jobs have reserved
+ * @param input_file   BMP image filename to read
+ * @param output_file  BMP image filename to write
+ * @param params       the process to run
+ * @param bytes_copied set to the pixel data copied while processing
+ * @return True if successful and false otherwise
+ */
+bool process_file(string input_file, string output_file, const ProcessParams& params, long long& bytes_copied) {
+    bytes_copied = 0;
+
+    //images too large to hold in memory, next to the other jobs still running, are
+    //processed tile by tile from a memory-mapped file
+    BmpInfo info;
+    if(!read_bmp_info(input_file, info)) {
+        return false;
+    }
+    MemoryReservation reservation(decoded_bytes(info, params));
+    if(!reservation.granted()) {
+        return process_out_of_core(input_file, output_file, params, OUT_OF_CORE_TILE_SIZE);
+    }
+
+    //count the pixel data copied for this job
+    shared_ptr<CopyCounter> copies(new CopyCounter());
+
+    //call read_image_large()
+    ImageHandle input_bmp(read_image_large(input_file), copies);
+
+    //call processing function that was selected; the input is not needed again, so hand it over
+    ImageHandle processed_image = run_process(params, move(input_bmp));
+
+    //store the bool output of write_image_large()
+    bool success = write_image_large(output_file, processed_image.read());
+    bytes_copied = copies->bytes;
+    return success;
+};
+
+/**
+ * Runs the selected process on a decimated proxy of the input, for a quick look at the result
+ * @param input_file BMP image filename to read
+ * @param params     the process to run
+ * @param factor     how many input pixels each preview pixel stands for along each axis
+ * @return handle to the processed preview, empty if the input is not a valid image
+ */
+ImageHandle preview_process(string input_file, const ProcessParams& params, int factor) {
+    shared_ptr<CopyCounter> copies(new CopyCounter());
+    ImageHandle proxy(read_image_decimated(input_file, factor), copies);
+    if(proxy.empty()) {
+        return proxy;
+    }
+    return run_process(params, move(proxy));
+};
+
+/**
+ * A full resolution result being computed in the background to replace its preview
+ */
+struct BackgroundJob
+{
+    string input_file;
+    string output_file;
+    string disp_selected;
+    thread worker;
+    atomic<bool> done;
+    bool success;
+    long long bytes_copied;
+};
+
+/**
+ * Writes a preview of the selected process right away and starts the full resolution
+ * result in the background. The full result goes to a temporary file first and is then
+ * renamed over the preview, so the output file always holds a complete image.
+ * @param input_file    BMP image filename to read
+ * @param output_file   BMP image filename to write
+ * @param params        the process to run
+ * @param disp_selected name of the process, for reporting
+ * @return the background job, or an empty pointer if the preview could not be written
+ */
+shared_ptr<BackgroundJob> start_progressive(string input_file, string output_file, const ProcessParams& params, string disp_selected) {
+    ImageHandle preview = preview_process(input_file, params, PREVIEW_FACTOR);
+    if(preview.empty() || !write_image_large(output_file, preview.read())) {
+        return shared_ptr<BackgroundJob>();
+    }
+
+    shared_ptr<BackgroundJob> job(new BackgroundJob());
+    job->input_file = input_file;
+    job->output_file = output_file;
+    job->disp_selected = disp_selected;
+    job->done = false;
+    job->success = false;
+    job->bytes_copied = 0;
+
+    ProcessParams full_params = params;
+    job->worker = thread([job, full_params]() {
+        string partial_file = job->output_file + ".part";
+        //an exception escaping the thread would end the program, so report it as a failed job
+        try {
+            job->success = process_file(job->input_file, partial_file, full_params, job->bytes_copied) &&
+                rename(partial_file.c_str(), job->output_file.c_str()) == 0;
+        }
+        catch(...) {
+            job->success = false;
+        }
+        if(!job->success) {
+            remove(partial_file.c_str());
+        }
+        job->done = true;
+    });
+    return job;
+};
+
+/**
+ * Checks whether two paths name the same existing file, however they are spelled
+ * @param a first path
+ * @param b second path
+ * @return True if both paths exist and are the same file and false otherwise
+ */
+bool same_file(string a, string b) {
+    struct stat a_stat;
+    struct stat b_stat;
+    return stat(a.c_str(), &a_stat) == 0 && stat(b.c_str(), &b_stat) == 0 &&
+        a_stat.st_dev == b_stat.st_dev && a_stat.st_ino == b_stat.st_ino;
+};
+
+/**
+ * Reports background jobs that have finished and forgets them.
+ * Jobs that conflict with the files about to be used are waited for: those still writing
+ * read_file or write_file, and those still reading write_file.
+ * @param jobs       background jobs still being tracked
+ * @param wait_all   True to wait for every job
+ * @param read_file  file the next job will read, or empty
+ * @param write_file file the next job will write, or empty
+ */
+void finish_background_jobs(vector<shared_ptr<BackgroundJob>>& jobs, bool wait_all, string read_file, string write_file) {
+    for(size_t i = 0; i < jobs.size(); ) {
+        shared_ptr<BackgroundJob> job = jobs[i];
+        bool conflict = job->output_file == read_file || job->output_file == write_file || job->input_file == write_file ||
+            same_file(job->output_file, read_file) || same_file(job->output_file, write_file) || same_file(job->input_file, write_file);
+        if(!job->done && !wait_all && !conflict) {
+            i++;
+            continue;
+        }
+
+        job->worker.join();
+        if(job->success) {
+            cout << "Full resolution " << job->disp_selected << " written to " << job->output_file << "!" << endl;
+            cout << "Copied " << job->bytes_copied << " bytes of pixel data" << endl;
+        }
+        else {
+            cout << "Full resolution " << job->disp_selected << " failed for " << job->output_file << endl;
+        }
+        jobs.erase(jobs.begin() + i);
+    }
+};
+
+/**
+ * Waits for every background job when it goes out of scope, so jobs are joined on every
+ * way out of the menu, including errors
+ */
+struct BackgroundJobGuard
+{
+    vector<shared_ptr<BackgroundJob>>& jobs;
+
+    ~BackgroundJobGuard() {
+        finish_background_jobs(jobs, true, "", "");
+    }
+};
+
+/**
+ * Checks the fixed-point scaling constants against the double expressions they replace,
+ * for every color value 0..255
+ * @return the number of mismatches
+ */
+int test_fixed_point() {
+    int failures = 0;
+    for(int color = 0; color <= 255; color++) {
+        failures += darken_fixed(color, CLARENDON_DARKEN_FACTOR) != int(color * 0.3);
+        failures += darken_fixed(color, DARKEN_FACTOR) != int(color * .8);
+        failures += lighten_fixed(color, CLARENDON_LIGHTEN_FACTOR) != int(255 - (255 - color) * 0.3);
+        failures += lighten_fixed(color, LIGHTEN_FACTOR) != int(255 - (255 - color) * .8);
+    }
+    return failures;
+};
+
+/**
+ * Builds a small image with a different color at every pixel, for the self-test
+ * @param num_rows    image height in pixels
+ * @param num_columns image width in pixels
+ * @return the test image
+ */
+vector<vector<Pixel>> test_image(int num_rows, int num_columns) {
+    vector<vector<Pixel>> image(num_rows, vector<Pixel>(num_columns));
+    for(int row = 0; row < num_rows; row++) {
+        for(int col = 0; col < num_columns; col++) {
+            image[row][col].red = (row * 7 + col * 3) % 256;
+            image[row][col].green = (row * 11 + col * 13) % 256;
+            image[row][col].blue = (row * col) % 256;
+        }
+    }
+    return image;
+};
+
+/**
+ * Counts the pixels that differ between two images, or all of them if the sizes differ
+ * @param a first image
+ * @param b second image
+ * @return the number of differing pixels
+ */
+int count_differences(const vector<vector<Pixel>>& a, const vector<vector<Pixel>>& b) {
+    if(a.size() != b.size() || (!a.empty() && a[0].size() != b[0].size())) {
+        return max(1, int(a.size() * (a.empty() ? 0 : a[0].size())));
+    }
+    int differences = 0;
+    for(size_t row = 0; row < a.size(); row++) {
+        for(size_t col = 0; col < a[row].size(); col++) {
+            differences += a[row][col].red != b[row][col].red || a[row][col].green != b[row][col].green ||
+                a[row][col].blue != b[row][col].blue;
+        }
+    }
+    return differences;
+};
+
+/**
+ * Lists a process setting for every menu selection, with several rotations and scales
+ * @return the process settings to check
+ */
+vector<ProcessParams> test_params() {
+    vector<ProcessParams> all_params;
+    for(int selection = 0; selection <= 11; selection++) {
+        for(int number = -3; number <= 4; number++) {
+            bool rotates = selection == 5 || selection == 11;
+            if(number != 0 && !rotates) {
+                continue;
+            }
+            bool scales = selection == 6 || selection == 11;
+            ProcessParams params = {selection, number, scales ? 2 : 1, scales ? 3 : 1};
+            all_params.push_back(params);
+        }
+    }
+    return all_params;
+};
+
+/**
+ * Checks that every tile of a TiledView, reading only its source region, matches the
+ * same region of the whole-image result
+ * @return the number of mismatched pixels
+ */
+int test_tiled_view() {
+    vector<vector<Pixel>> image = test_image(37, 53);
+    vector<ProcessParams> all_params = test_params();
+    int failures = 0;
+
+    for(size_t i = 0; i < all_params.size(); i++) {
+        vector<vector<Pixel>> full = run_process(all_params[i], image);
+        TiledView<vector<vector<Pixel>>> view(image, all_params[i], 16);
+        for(int tile_row = 0; tile_row < view.tile_rows(); tile_row++) {
+            for(int tile_col = 0; tile_col < view.tile_cols(); tile_col++) {
+                Region tile = view.tile_region(tile_row, tile_col);
+                failures += count_differences(view.tile(tile_row, tile_col), run_process(all_params[i], image, tile));
+            }
+        }
+        failures += count_differences(view.region(full_region(view.rows(), view.cols())), full);
+    }
+    return failures;
+};
+
+/**
+ * Mirrors an image pixel by pixel, as a reference for the pipeline flips
+ * @param image      the input image
+ * @param horizontal True to mirror across the vertical axis, false for the horizontal axis
+ * @return the mirrored image
+ */
+vector<vector<Pixel>> reference_flip(const vector<vector<Pixel>>& image, bool horizontal) {
+    int num_rows = image.size();
+    int num_columns = image[0].size();
+    vector<vector<Pixel>> new_image(num_rows, vector<Pixel>(num_columns));
+    for(int row = 0; row < num_rows; row++) {
+        for(int col = 0; col < num_columns; col++) {
+            if(horizontal) {
+                new_image[row][col] = image[row][(num_columns - 1) - col];
+            }
+            else {
+                new_image[row][col] = image[(num_rows - 1) - row][col];
+            }
+        }
+    }
+    return new_image;
+};
+
+/**
+ * Scales an image by a fraction pixel by pixel, as a reference for the pipeline scale
+ * @param image         the input image
+ * @param x_numerator   horizontal scale numerator
+ * @param x_denominator horizontal scale denominator
+ * @param y_numerator   vertical scale numerator
+ * @param y_denominator vertical scale denominator
+ * @return the scaled image
+ */
+vector<vector<Pixel>> reference_scale(const vector<vector<Pixel>>& image, int x_numerator, int x_denominator, int y_numerator, int y_denominator) {
+    int new_num_rows = image.size() * y_numerator / y_denominator;
+    int new_num_columns = image[0].size() * x_numerator / x_denominator;
+    vector<vector<Pixel>> new_image(new_num_rows, vector<Pixel>(new_num_columns));
+    for(int row = 0; row < new_num_rows; row++) {
+        for(int col = 0; col < new_num_columns; col++) {
+            new_image[row][col] = image[row * y_denominator / y_numerator][col * x_denominator / x_numerator];
+        }
+    }
+    return new_image;
+};
+
+/**
+ * Checks the single-pass rotate and enlarge against running the processes one after another
+ * @return the number of mismatched pixels
+ */
+int test_geometric_pipeline() {
+    vector<vector<Pixel>> image = test_image(23, 17);
+    int failures = 0;
+
+    for(int number = -3; number <= 5; number++) {
+        for(int x_scale = 1; x_scale <= 3; x_scale++) {
+            for(int y_scale = 1; y_scale <= 3; y_scale++) {
+                vector<vector<Pixel>> sequential = process_6(process_5(image, number), x_scale, y_scale);
+                failures += count_differences(process_11(image, number, x_scale, y_scale), sequential);
+
+                ProcessParams params = {11, number, x_scale, y_scale};
+                params = prepare_process(params, image.size(), image[0].size());
+                failures += count_differences(run_process(params, image), sequential);
+
+                //enlarging first and rotating after must match too
+                GeometricPipeline pipeline(image.size(), image[0].size());
+                pipeline.enlarge(x_scale, y_scale);
+                pipeline.rotate(number);
+                failures += count_differences(pipeline.apply(image), process_5(process_6(image, x_scale, y_scale), number));
+            }
+        }
+    }
+    return failures;
+};
+
+/**
+ * Checks chains of flips, fractional scales and rotations against applying each step
+ * to a whole image in turn
+ * @return the number of mismatched pixels
+ */
+int test_flips_and_scales() {
+    vector<vector<Pixel>> image = test_image(23, 17);
+    int fractions[][2] = {{1, 2}, {2, 3}, {3, 2}, {5, 4}, {2, 1}};
+    int num_fractions = sizeof(fractions) / sizeof(fractions[0]);
+    int failures = 0;
+
+    for(int number = -1; number <= 2; number++) {
+        for(int flips = 0; flips < 4; flips++) {
+            for(int x = 0; x < num_fractions; x++) {
+                for(int y = 0; y < num_fractions; y++) {
+                    //flip horizontally, rotate, scale, then flip vertically
+                    GeometricPipeline pipeline(image.size(), image[0].size());
+                    vector<vector<Pixel>> sequential = image;
+                    if(flips & 1) {
+                        pipeline.flip_horizontal();
+                        sequential = reference_flip(sequential, true);
+                    }
+                    pipeline.rotate(number);
+                    sequential = process_5(sequential, number);
+                    pipeline.scale(fractions[x][0], fractions[x][1], fractions[y][0], fractions[y][1]);
+                    sequential = reference_scale(sequential, fractions[x][0], fractions[x][1], fractions[y][0], fractions[y][1]);
+                    if(flips & 2) {
+                        pipeline.flip_vertical();
+                        sequential = reference_flip(sequential, false);
+                    }
+                    failures += count_differences(pipeline.apply(image), sequential);
+
+                    //a region of the output must only read inside its source region
+                    Region roi = {pipeline.rows() / 3, pipeline.cols() / 4, pipeline.rows() / 2, pipeline.cols() / 2};
+                    ImageWindow window(image, pipeline.source_region(roi));
+                    vector<vector<Pixel>> expected;
+                    for(int row = roi.row; row < roi.row + roi.rows; row++) {
+                        expected.push_back(vector<Pixel>(sequential[row].begin() + roi.col, sequential[row].begin() + roi.col + roi.cols));
+                    }
+                    failures += count_differences(pipeline.apply(window, roi), expected);
+                }
+            }
+        }
+    }
+    return failures;
+};
+
+/**
+ * Runs the built-in checks and reports each one
+ * Usage: main --self-test
+ * @return 0 if every check passed and 1 otherwise
+ */
+int self_test() {
+    int failed_checks = 0;
+    struct { const char* name; int (*check)(); } checks[] = {
+        {"fixed-point scaling", test_fixed_point},
+        {"tiled view", test_tiled_view},
+        {"geometric pipeline", test_geometric_pipeline},
+        {"flips and scales", test_flips_and_scales},
+    };
+
+    for(size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        int failures = checks[i].check();
+        cout << (failures == 0 ? "PASS " : "FAIL ") << checks[i].name;
+        if(failures != 0) {
+            cout << " (" << failures << " mismatches)";
+            failed_checks++;
+        }
+        cout << endl;
+    }
+    return failed_checks == 0 ? 0 : 1;
+};
+
+//run the CLI for the image processing app
+void cli_process() {
+
+    //startup
+    cout << "CSPB 1300 Image Processing Application" << endl;
+    
+    //store input file name
+    string input_file;
+    
+    while(true) {
+        //verify input file exists
+        cout << "Enter input BMP filename: " << endl;
+        cin >> input_file;
+        ifstream file(input_file);
+        if(!file.good()) {
+            cout << "File does not exist, enter a .bmp path that exists." << endl;
+        }
+        else {
+            break;
+        }
+    }
+
+    //define to control loop, checking for 'Q'
+    string menu_selection;
+
+    //full resolution results still being computed after their previews were written
+    vector<shared_ptr<BackgroundJob>> background_jobs;
+    BackgroundJobGuard background_guard = {background_jobs};
+
+    do{
+        finish_background_jobs(background_jobs, false, "", "");
+
+        //display CLI menu
+        cout << "IMAGE PROCESSING MENU" << endl;
+        cout << "0) Change image (current: " << input_file << ")" << endl;
+        cout << "1) Vignette" << endl;
+        cout << "2) Clarendon" << endl;
+        cout << "3) Grayscale" << endl;
+        cout << "4) Rotate 90 degrees" << endl;
+        cout << "5) Rotate multiple 90 degrees" << endl;
+        cout << "6) Enlarge" << endl;
+        cout << "7) High contrast" << endl;
+        cout << "8) Lighten" << endl;
+        cout << "9) Darken" << endl;
+        cout << "10) Black, white, red, green, blue" << endl;
+        cout << "11) Rotate and enlarge" << endl;
+
+        cout << endl;
+        cout << "Enter menu selection (Q to quit): ";
+
+        //store menu selection
+        cin >> menu_selection;
+
+        //quit interrupt
+        if(menu_selection == "Q") {
+            if(!background_jobs.empty()) {
+                cout << "Waiting for full resolution results..." << endl;
+            }
+            finish_background_jobs(background_jobs, true, "", "");
+            break;
+        }
+
+        //create the long names of processes for display after selection
+        string disp_selected;
+        switch(stoi(menu_selection)) {
+            case 1: disp_selected = "Vignette"; break;
+            case 2: disp_selected = "Clarendon"; break;
+            case 3: disp_selected = "Grayscale"; break;
+            case 4: disp_selected = "Rotate 90 degrees"; break;
+            case 5: disp_selected = "Rotate multiple 90 degrees"; break;
+            case 6: disp_selected = "Enlarge"; break;
+            case 7: disp_selected = "High contrast"; break;
+            case 8: disp_selected = "Lighten"; break;
+            case 9: disp_selected = "Darken"; break;
+            case 10: disp_selected = "Black, white, red, green, blue"; break;
+            case 11: disp_selected = "Rotate and enlarge"; break;
+        }
+
+        //receive menu_selection
+        //store output file name
+        cout << endl;
+        cout << disp_selected << " selected" << endl;
 
         string output_file;
 
@@ -717,6 +2878,7 @@ void cli_process() {
         if(menu_selection == "0") {
             cout << "Enter new input BMP filename: ";
             cin >> input_file;
+            finish_background_jobs(background_jobs, false, input_file, "");
             cout << "Successfully changed input image!" << endl;
         }
         else {
@@ -724,7 +2886,7 @@ void cli_process() {
             while(true) {
                 cout << "Enter output BMP filename: ";
                 cin >> output_file;
-                if(output_file == input_file) {
+                if(output_file == input_file || same_file(output_file, input_file)) {
                     cout << "Enter a different file from the input file." << endl;
                 }
                 else {
@@ -732,61 +2894,48 @@ void cli_process() {
                 }
             }
     
-            //action
-            //call read_image()
-            vector<vector<Pixel>> input_bmp = read_image(input_file);
-    
-            //call processing function that was selected
-            vector<vector<Pixel>> processed_image;
-            string selection_name;
+            //collect the inputs for the processing function that was selected
+            ProcessParams params = {stoi(menu_selection), 0, 1, 1};
 
-            if(menu_selection == "1") {
-                processed_image = process_1(input_bmp);
-            }
-            else if(menu_selection == "2") {
-                processed_image = process_2(input_bmp);
-            }
-            else if(menu_selection == "3") {
-                processed_image = process_3(input_bmp);
-            }
-            else if(menu_selection == "4") {
-                processed_image = process_4(input_bmp);
-            }
-            else if(menu_selection == "5") {
-                int number;
+            if(menu_selection == "5" || menu_selection == "11") {
                 cout << "Enter number of rotations: ";
-                cin >> number;
-                processed_image = process_5(input_bmp, number);
+                cin >> params.number;
             }
-            else if(menu_selection == "6") {
-                int x_scale;
-                int y_scale;
+            if(menu_selection == "6" || menu_selection == "11") {
                 cout << "Enter x scale: ";
-                cin >> x_scale;
+                cin >> params.x_scale;
                 cout << endl;
                 cout << "Enter y scale: ";
-                cin >> y_scale;
-                processed_image = process_6(input_bmp, x_scale, y_scale);
-            }
-            else if(menu_selection == "7") {
-                processed_image = process_7(input_bmp);
+                cin >> params.y_scale;
             }
-            else if(menu_selection == "8") {
-                processed_image = process_8(input_bmp);
-            }
-            else if(menu_selection == "9") {
-                processed_image = process_9(input_bmp);
+
+            //action
+            //a job still writing either file has to finish before this one starts
+            finish_background_jobs(background_jobs, false, input_file, output_file);
+
+            //large images get a quick preview first, then the full resolution result replaces it
+            BmpInfo info;
+            bool success = read_bmp_info(input_file, info);
+            bool previewed = success && info.file_size > PREVIEW_BYTES;
+            if(previewed) {
+                shared_ptr<BackgroundJob> job = start_progressive(input_file, output_file, params, disp_selected);
+                success = job.get() != NULL;
+                if(success) {
+                    background_jobs.push_back(job);
+                }
             }
-            else if(menu_selection == "10") {
-                processed_image = process_10(input_bmp);
+            else if(success) {
+                long long bytes_copied;
+                success = process_file(input_file, output_file, params, bytes_copied);
+                cout << "Copied " << bytes_copied << " bytes of pixel data" << endl;
             }
     
-            //store the bool output of write_image()
-            bool success = write_image(output_file, processed_image);
-    
             //result
             //check for successful return from write_image()
-            if(success) {
+            if(success && previewed) {
+                cout << "Preview of " << disp_selected << " written to " << output_file << ", full resolution result in progress" << endl;
+            }
+            else if(success) {
                 cout << "Successfully applied " << disp_selected << "!" << endl;
             }
             else {
@@ -799,8 +2948,16 @@ void cli_process() {
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
+        //run a whole directory or manifest without the menu
+        if(argc > 1 && string(argv[1]) == "--batch") {
+            return batch_process(argc, argv);
+        }
+        //check the processing functions against their reference behavior
+        if(argc > 1 && string(argv[1]) == "--self-test") {
+            return self_test();
+        }
         cli_process();
     }
     catch(...) {